@@ -1,3 +1,3 @@
 #!/bin/sh
 
-cc -D CIRCUITBREAKER_SLOW=1 main.c cb_board.c cb_street.c -g $(pkg-config --libs --cflags raylib) -o main
+cc -O2 -D CIRCUITBREAKER_SLOW=1 main.c cb_board.c cb_street.c cb_pacer.c cb_sim.c cb_dataset.c cb_boardgen.c -g -pthread $(pkg-config --libs --cflags raylib) -o main
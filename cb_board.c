@@ -26,24 +26,6 @@ typedef enum {
  * ADDING -> end adding -> IDLE
 */
 
-typedef enum {
-    TILETYPE_EMPTY,
-    TILETYPE_ATTACK,
-    TILETYPE_ACTION,
-    TILETYPE_UTILITY,
-    TILETYPE_CNT,
-} TileType;
-
-typedef struct {
-    real64 x, y;
-    uint32 row_dest; 
-    uint32 frame;
-    real64 vspeed;
-    TileType tile_type;
-    bool falling;
-    bool hrotating;
-} Tile;
-
 typedef struct {
     uint32 x, y;
 } BoardPos;
@@ -58,38 +40,194 @@ typedef enum {
     ROTATING_RIGHT,
 } BoardRotationDirection;
 
+#define BOARD_MAX_RANGES (BOARD_MAX_WIDTH * BOARD_MAX_HEIGHT / 3 + 1)
+
+typedef struct Board Board;
+
 typedef struct {
+    const char *name;
+    uint32 width, height;
+    void (*find_matches)(Board *b);
+    void (*rotate_row_left)(Board *b, uint32 row);
+    void (*rotate_row_right)(Board *b, uint32 row);
+    void (*start_falling)(Board *b);
+} BoardKernels;
+
+struct Board {
     BoardState state;
     Texture2D tile_textures[TILETYPE_CNT];
     Texture2D arrow_texture;
-    Tile tiles[BOARD_HEIGHT][BOARD_WIDTH];
+    uint32 width, height;
+    const BoardKernels *kernels;
+    Tile tiles[BOARD_MAX_HEIGHT][BOARD_MAX_WIDTH];
     uint32 cursor_row;
     uint32 horiz_ranges_cnt;
     uint32 vert_ranges_cnt;
     uint32 break_iterations;
-    BoardRange horiz_ranges[BOARD_HEIGHT];
-    BoardRange vert_ranges[BOARD_WIDTH];
+    BoardRange horiz_ranges[BOARD_MAX_RANGES];
+    BoardRange vert_ranges[BOARD_MAX_RANGES];
     BoardRotationDirection direction;
     real64 hspeed;
-} Board;
+};
 
 Board board = {
     .state = BOARDSTATE_IDLE,
     .tile_textures = { 0 },
+    .width = BOARD_WIDTH,
+    .height = BOARD_HEIGHT,
     .tiles = {0},
     .cursor_row = 1,
     .horiz_ranges = { 0 },
     .vert_ranges = { 0 },
 };
 
-void board_rotate_row_left(int row);
-void board_rotate_row_right(int row);
-int board_find_row_dest(int x, int start);
+/*
+ * Board kernels:
+ *
+ * Match detection, row rotation and the start of gravity are written once
+ * as force_inline functions taking the size as parameters. BOARD_KERNEL_SIZES
+ * stamps out a copy per popular size with the size as a compile-time
+ * constant. The outer loops are marked unroll_loop, since -O2 alone keeps
+ * them rolled and the constant copies then run no faster than the generic
+ * one. The data-dependent falling scans stay rolled. Any other size uses
+ * the generic copy, which reads the size from the board.
+ *
+ * board_init picks the kernels matching the board size.
+*/
+
+#define BOARD_KERNEL_SIZES(X) \
+    X(4, 5) \
+    X(6, 8) \
+    X(8, 8)
+
+force_inline void board_kernel_find_matches(Board *b, uint32 w, uint32 h) {
+    uint32 horiz_cnt = 0;
+    unroll_loop
+    for (uint32 y = 1; y < h; y++) {
+        uint32 run_start = 0;
+        unroll_loop
+        for (uint32 x = 1; x <= w; x++) {
+            TileType run_type = b->tiles[y][run_start].tile_type;
+            if (x == w || b->tiles[y][x].tile_type != run_type) {
+                // Write unconditionally, only keep it if the run is a match
+                b->horiz_ranges[horiz_cnt] = (BoardRange){ {run_start, y}, {x - 1, y} };
+                horiz_cnt += (x - run_start >= 3) & (run_type != TILETYPE_EMPTY);
+                run_start = x;
+            }
+        }
+    }
+    b->horiz_ranges_cnt = horiz_cnt;
+
+    uint32 vert_cnt = 0;
+    unroll_loop
+    for (uint32 x = 0; x < w; x++) {
+        uint32 run_start = 1;
+        unroll_loop
+        for (uint32 y = 2; y <= h; y++) {
+            TileType run_type = b->tiles[run_start][x].tile_type;
+            if (y == h || b->tiles[y][x].tile_type != run_type) {
+                b->vert_ranges[vert_cnt] = (BoardRange){ {x, run_start}, {x, y - 1} };
+                vert_cnt += (y - run_start >= 3) & (run_type != TILETYPE_EMPTY);
+                run_start = y;
+            }
+        }
+    }
+    b->vert_ranges_cnt = vert_cnt;
+}
+
+force_inline void board_kernel_rotate_row_left(Board *b, uint32 w, uint32 row) {
+    TileType first = b->tiles[row][0].tile_type;
+    unroll_loop
+    for (uint32 n = 1; n < w; n++) {
+        b->tiles[row][n - 1].tile_type = b->tiles[row][n].tile_type;
+    }
+    b->tiles[row][w - 1].tile_type = first;
+}
+
+force_inline void board_kernel_rotate_row_right(Board *b, uint32 w, uint32 row) {
+    TileType last = b->tiles[row][w - 1].tile_type;
+    unroll_loop
+    for (uint32 n = w - 1; n > 0; n--) {
+        b->tiles[row][n].tile_type = b->tiles[row][n - 1].tile_type;
+    }
+    b->tiles[row][0].tile_type = last;
+}
+
+force_inline uint32 board_kernel_find_row_dest(Board *b, uint32 h, uint32 x, uint32 start) {
+    uint32 dest = start;
+    for (; dest < h - 1; dest++) {
+        if (b->tiles[dest + 1][x].tile_type != TILETYPE_EMPTY) {
+            break;
+        }
+    }
+    return dest;
+}
+
+force_inline void board_kernel_start_falling(Board *b, uint32 w, uint32 h) {
+    unroll_loop
+    for (int32 y = h - 2; y >= 0; y--) {
+        unroll_loop
+        for (uint32 x = 0; x < w; x++) {
+            if (b->tiles[y][x].tile_type == TILETYPE_EMPTY) {
+                continue;
+            }
+            if (b->tiles[y + 1][x].tile_type == TILETYPE_EMPTY && b->tiles[y][x].falling == false) {
+                for (int32 n = y; n >= 0; n--) {
+                    if (b->tiles[n][x].tile_type != TILETYPE_EMPTY) {
+                        b->tiles[n][x].falling = true;
+                        b->tiles[n][x].vspeed = (real64)100;
+                        b->tiles[n][x].row_dest = board_kernel_find_row_dest(b, h, x, n) * CELL_SIZE;
+                    }
+                }
+            }
+        }
+    }
+}
+
+#define BOARD_KERNELS_DEFINE(W, H) \
+    void board_find_matches_##W##x##H(Board *b) { board_kernel_find_matches(b, W, H); } \
+    void board_rotate_row_left_##W##x##H(Board *b, uint32 row) { board_kernel_rotate_row_left(b, W, row); } \
+    void board_rotate_row_right_##W##x##H(Board *b, uint32 row) { board_kernel_rotate_row_right(b, W, row); } \
+    void board_start_falling_##W##x##H(Board *b) { board_kernel_start_falling(b, W, H); }
+
+#define BOARD_KERNELS_ENTRY(W, H) \
+    { #W "x" #H, W, H, \
+      board_find_matches_##W##x##H, \
+      board_rotate_row_left_##W##x##H, \
+      board_rotate_row_right_##W##x##H, \
+      board_start_falling_##W##x##H },
+
+BOARD_KERNEL_SIZES(BOARD_KERNELS_DEFINE)
+
+void board_find_matches_generic(Board *b) { board_kernel_find_matches(b, b->width, b->height); }
+void board_rotate_row_left_generic(Board *b, uint32 row) { board_kernel_rotate_row_left(b, b->width, row); }
+void board_rotate_row_right_generic(Board *b, uint32 row) { board_kernel_rotate_row_right(b, b->width, row); }
+void board_start_falling_generic(Board *b) { board_kernel_start_falling(b, b->width, b->height); }
+
+global_variable const BoardKernels board_kernels[] = {
+    BOARD_KERNEL_SIZES(BOARD_KERNELS_ENTRY)
+};
+
+global_variable const BoardKernels board_kernels_generic = {
+    "generic", 0, 0,
+    board_find_matches_generic,
+    board_rotate_row_left_generic,
+    board_rotate_row_right_generic,
+    board_start_falling_generic,
+};
+
+const BoardKernels *board_find_kernels(uint32 width, uint32 height) {
+    for (int n = 0; n < sizeof(board_kernels) / sizeof(board_kernels[0]); n++) {
+        if (board_kernels[n].width == width && board_kernels[n].height == height) {
+            return &board_kernels[n];
+        }
+    }
+    return &board_kernels_generic;
+}
+
 bool board_tiles_falling();
 bool board_tiles_empty();
 bool board_first_row_tiles_empty();
-void board_find_horiz_matches();
-void board_find_vert_matches();
 void board_delete_horiz_range(BoardRange range);
 void board_delete_vert_range(BoardRange range);
 void board_anime_horiz_range(BoardRange range);
@@ -97,8 +235,8 @@ void board_anime_vert_range(BoardRange range);
 
 void board_debug_print() {
     printf("Board state: %d\n", board.state);
-    for (int y  = 0; y < BOARD_HEIGHT; y++) {
-        for (int x  = 0; x < BOARD_WIDTH; x++) {
+    for (int y  = 0; y < board.height; y++) {
+        for (int x  = 0; x < board.width; x++) {
             printf("%d%c(%3f,%3f,%3f) ",
                    board.tiles[y][x].tile_type,
                    board.tiles[y][x].falling ? 'f' : ' ',
@@ -128,15 +266,47 @@ void board_range_print() {
     }
 }
 
-void board_init() {
+void board_load() {
     board.tile_textures[TILETYPE_ATTACK] = LoadTexture("resources/tilesheet_attack.png");
     board.tile_textures[TILETYPE_ACTION] = LoadTexture("resources/tilesheet_action.png");
     board.tile_textures[TILETYPE_UTILITY] = LoadTexture("resources/tilesheet_utility.png");
     board.arrow_texture = LoadTexture("resources/arrow.png");
+}
+
+bool32 board_set_size(uint32 width, uint32 height) {
+    if (width < BOARD_MIN_WIDTH || width > BOARD_MAX_WIDTH ||
+        height < BOARD_MIN_HEIGHT || height > BOARD_MAX_HEIGHT) {
+        return false;
+    }
+    board.width = width;
+    board.height = height;
+    board.kernels = board_find_kernels(board.width, board.height);
+    printf("board: %ux%u using %s kernels\n", board.width, board.height, board.kernels->name);
+    return true;
+}
 
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            TileType tile_type = y == 0 ? TILETYPE_EMPTY : rand() % TILETYPE_CNT;
+void board_init() {
+    board.kernels = board_find_kernels(board.width, board.height);
+
+    board.state = BOARDSTATE_IDLE;
+    board.cursor_row = 1;
+    board.horiz_ranges_cnt = 0;
+    board.vert_ranges_cnt = 0;
+    board.break_iterations = 0;
+
+    // Seeded from rand() so srand still decides the starting board
+    BoardGenerator gen;
+    board_generator_init(&gen, ((uint64)rand() << 32) ^ (uint64)rand(), BOARD_START_MIN_MOVES);
+    uint8 cells[BOARD_MAX_HEIGHT][BOARD_MAX_WIDTH];
+    uint32 moves;
+    if (!board_generate(&gen, board.width, board.height, cells, &moves)) {
+        // Still match-free, so play it rather than stall the restart
+        printf("board: starting board has only %u productive moves\n", moves);
+    }
+
+    for (int y = 0; y < board.height; y++) {
+        for (int x = 0; x < board.width; x++) {
+            TileType tile_type = cells[y][x];
             board.tiles[y][x] = (Tile){ .x = x * CELL_SIZE, .y = y * CELL_SIZE, .tile_type = tile_type, .falling = false, .vspeed = 0};
         }
     }
@@ -165,57 +335,40 @@ void board_update_state() {
     }
 }
 
-void board_update(real64 elapsed_time) {
-    if (IsKeyPressed(KEY_UP)) {
+void board_input(InputEvent event) {
+    if (event == INPUT_UP) {
         if (board.cursor_row > 1) {
             board.cursor_row--;
         }
     }
-    if (IsKeyPressed(KEY_DOWN)) {
-        if (board.cursor_row < BOARD_HEIGHT - 1) {
+    if (event == INPUT_DOWN) {
+        if (board.cursor_row < board.height - 1) {
             board.cursor_row++;
         }
     }
-    if (IsKeyPressed(KEY_LEFT)) {
+    if (event == INPUT_LEFT) {
         if (board.state == BOARDSTATE_IDLE) {
             board.state = BOARDSTATE_ROTATING;
             board.hspeed = (real64)100;
             board.direction = ROTATING_LEFT;
         }
     }
-    if (IsKeyPressed(KEY_RIGHT)) {
+    if (event == INPUT_RIGHT) {
         if (board.state == BOARDSTATE_IDLE) {
             board.state = BOARDSTATE_ROTATING;
             board.hspeed = (real64)100;
             board.direction = ROTATING_RIGHT;
         }
     }
+}
+
+void board_update(real64 elapsed_time) {
     if (board.state == BOARDSTATE_IDLE) {
-        for (int y = BOARD_HEIGHT - 2; y >= 0; y--) {
-            for (int x = 0; x < BOARD_WIDTH; x++) {
-                if (board.tiles[y][x].tile_type == TILETYPE_EMPTY) {
-                    continue;
-                }
-                if (board.tiles[y + 1][x].tile_type == TILETYPE_EMPTY && board.tiles[y][x].falling == false) {
-                    board.tiles[y][x].falling = true;
-                    board.tiles[y][x].vspeed = (real64)100;
-                    board.tiles[y][x].row_dest = board_find_row_dest(x, y) * CELL_SIZE;
-                    if (y > 0) {
-                        for (int n = y - 1; n >= 0; n--) {
-                            if (board.tiles[n][x].tile_type != TILETYPE_EMPTY) {
-                                board.tiles[n][x].falling = true;
-                                board.tiles[n][x].vspeed = (real64)100;
-                                board.tiles[n][x].row_dest = board_find_row_dest(x, n) * CELL_SIZE;
-                            }
-                        }
-                    }
-                }
-            }
-        }
+        board.kernels->start_falling(&board);
     }
     if (board.state == BOARDSTATE_FALLING) {
-        for (int y = BOARD_HEIGHT - 2; y >= 0; y--) {
-            for (int x = 0; x < BOARD_WIDTH; x++) {
+        for (int y = board.height - 2; y >= 0; y--) {
+            for (int x = 0; x < board.width; x++) {
                 if (board.tiles[y][x].falling == true) {
                     board.tiles[y][x].y += board.tiles[y][x].vspeed * elapsed_time;
                     board.tiles[y][x].vspeed *= 1.1 + ((real32)rand()/(real32)(RAND_MAX)) * 0.4;
@@ -234,34 +387,34 @@ void board_update(real64 elapsed_time) {
     if (board.state == BOARDSTATE_ROTATING) {
         if (board.direction == ROTATING_LEFT) {
             board.hspeed *= (real64)1.2;
-            for (int n = 0; n < BOARD_WIDTH; n++) {
+            for (int n = 0; n < board.width; n++) {
                 board.tiles[board.cursor_row][n].x -= board.hspeed * elapsed_time;
             }
             if (board.tiles[board.cursor_row][1].x <= 0) {
-                for (int n = 0; n < BOARD_WIDTH; n++) {
+                for (int n = 0; n < board.width; n++) {
                     board.tiles[board.cursor_row][n].x = n * CELL_SIZE;
                 }
-                board_rotate_row_left(board.cursor_row);
+                board.kernels->rotate_row_left(&board, board.cursor_row);
                 board.state = BOARDSTATE_IDLE;
             }
         }
         else if (board.direction == ROTATING_RIGHT) {
             board.hspeed *= (real64)1.2;
-            for (int n = 0; n < BOARD_WIDTH; n++) {
+            for (int n = 0; n < board.width; n++) {
                 board.tiles[board.cursor_row][n].x += board.hspeed * elapsed_time;
             }
             if (board.tiles[board.cursor_row][0].x >= CELL_SIZE) {
-                for (int n = 0; n < BOARD_WIDTH; n++) {
+                for (int n = 0; n < board.width; n++) {
                     board.tiles[board.cursor_row][n].x = n * CELL_SIZE;
                 }
-                board_rotate_row_right(board.cursor_row);
+                board.kernels->rotate_row_right(&board, board.cursor_row);
                 board.state = BOARDSTATE_IDLE;
             }
         }
     }
     if (board.state == BOARDSTATE_ADDING) {
         // Add tiles
-        for (int n = 0; n < BOARD_WIDTH; n++) {
+        for (int n = 0; n < board.width; n++) {
             if (board.tiles[0][n].tile_type == TILETYPE_EMPTY && board.tiles[1][n].tile_type == TILETYPE_EMPTY) {
                 board.tiles[0][n].tile_type = rand() % (TILETYPE_CNT - 1) + 1;
                 board.tiles[0][n].x = n * CELL_SIZE;
@@ -300,21 +453,134 @@ void board_update(real64 elapsed_time) {
         }
     }
     board_debug_print();
-    board_find_horiz_matches();
-    board_find_vert_matches();
+    board.kernels->find_matches(&board);
     board_update_state();
 }
 
-void board_draw(uint16 pos_x, uint16 pos_y) {
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            Texture2D *tile = NULL;
+/*
+ * Logical move model, used headless:
+ *
+ * Same rules as the animated state machine but resolved instantly. Each
+ * round breaks every match, collapses the columns and refills rows
+ * 1..height-1 from the top, until no match is left. Row 0 stays empty like
+ * after ADDING + FALLING settle.
+*/
+
+uint32 board_resolve_round() {
+    bool broken[BOARD_MAX_HEIGHT][BOARD_MAX_WIDTH] = {0};
+    for (int n = 0; n < board.horiz_ranges_cnt; n++) {
+        BoardRange range = board.horiz_ranges[n];
+        for (int x = range.start.x; x <= range.end.x; x++) {
+            broken[range.start.y][x] = true;
+        }
+    }
+    for (int n = 0; n < board.vert_ranges_cnt; n++) {
+        BoardRange range = board.vert_ranges[n];
+        for (int y = range.start.y; y <= range.end.y; y++) {
+            broken[y][range.start.x] = true;
+        }
+    }
+
+    uint32 broken_cnt = 0;
+    for (int x = 0; x < board.width; x++) {
+        int dest = board.height - 1;
+        for (int y = board.height - 1; y >= 0; y--) {
+            if (broken[y][x]) {
+                broken_cnt++;
+                continue;
+            }
             if (board.tiles[y][x].tile_type != TILETYPE_EMPTY) {
-                tile = &board.tile_textures[board.tiles[y][x].tile_type];
-                Rectangle source = { .x = (board.tiles[y][x].frame % 3) * CELL_SIZE, .y = 0, .width = CELL_SIZE, .height = CELL_SIZE };
-                Vector2 position = { .x = pos_x + board.tiles[y][x].x, .y = pos_y + board.tiles[y][x].y };
-                if (board.tiles[y][x].x < 0) {
-                    int32 clamp = fabsf(board.tiles[y][x].x);
+                board.tiles[dest--][x].tile_type = board.tiles[y][x].tile_type;
+            }
+        }
+        for (; dest >= 0; dest--) {
+            board.tiles[dest][x].tile_type = TILETYPE_EMPTY;
+        }
+    }
+
+    for (int y = 0; y < board.height; y++) {
+        for (int x = 0; x < board.width; x++) {
+            TileType tile_type = board.tiles[y][x].tile_type;
+            if (y > 0 && tile_type == TILETYPE_EMPTY) {
+                tile_type = rand() % (TILETYPE_CNT - 1) + 1;
+            }
+            board.tiles[y][x] = (Tile){ .x = x * CELL_SIZE, .y = y * CELL_SIZE, .tile_type = y == 0 ? TILETYPE_EMPTY : tile_type };
+        }
+    }
+    return broken_cnt;
+}
+
+void board_settle(BoardMoveResult *result) {
+    *result = (BoardMoveResult){0};
+    for (;;) {
+        board.kernels->find_matches(&board);
+        if (board.horiz_ranges_cnt == 0 && board.vert_ranges_cnt == 0) {
+            break;
+        }
+        uint32 broken_cnt = board_resolve_round();
+        uint32 event = result->cascades < BOARD_MAX_CASCADE_EVENTS ? result->cascades : BOARD_MAX_CASCADE_EVENTS - 1;
+        uint32 event_tiles = result->cascade_tiles[event] + broken_cnt;
+        result->cascade_tiles[event] = event_tiles < 255 ? event_tiles : 255;
+        result->cascades++;
+        result->tiles_broken += broken_cnt;
+        result->reward += (real32)(broken_cnt * result->cascades);
+    }
+}
+
+void board_apply_move(uint32 row, InputEvent direction, BoardMoveResult *result) {
+    Assert(row > 0 && row < board.height);
+    if (direction == INPUT_LEFT) {
+        board.kernels->rotate_row_left(&board, row);
+    } else if (direction == INPUT_RIGHT) {
+        board.kernels->rotate_row_right(&board, row);
+    }
+    board.cursor_row = row;
+    board_settle(result);
+}
+
+void board_pack(uint64 packed[2]) {
+    packed[0] = 0;
+    packed[1] = 0;
+    for (int y = 0; y < board.height; y++) {
+        for (int x = 0; x < board.width; x++) {
+            uint32 n = y * board.width + x;
+            packed[n / 32] |= (uint64)board.tiles[y][x].tile_type << ((n % 32) * 2);
+        }
+    }
+}
+
+bool32 board_is_idle() {
+    return board.state == BOARDSTATE_IDLE &&
+        board.horiz_ranges_cnt == 0 &&
+        board.vert_ranges_cnt == 0 &&
+        !board_tiles_falling() &&
+        !board_first_row_tiles_empty();
+}
+
+void board_snapshot(BoardSnapshot *snapshot) {
+    snapshot->width = board.width;
+    snapshot->height = board.height;
+    for (int y = 0; y < board.height; y++) {
+        for (int x = 0; x < board.width; x++) {
+            snapshot->tiles[y][x] = board.tiles[y][x];
+        }
+    }
+    snapshot->cursor_row = board.cursor_row;
+    snapshot->idle = board_is_idle();
+}
+
+void board_draw(const BoardSnapshot *snapshot, uint16 pos_x, uint16 pos_y) {
+    const Tile (*tiles)[BOARD_MAX_WIDTH] = snapshot->tiles;
+
+    for (int y = 0; y < snapshot->height; y++) {
+        for (int x = 0; x < snapshot->width; x++) {
+            Texture2D *tile = NULL;
+            if (tiles[y][x].tile_type != TILETYPE_EMPTY) {
+                tile = &board.tile_textures[tiles[y][x].tile_type];
+                Rectangle source = { .x = (tiles[y][x].frame % 3) * CELL_SIZE, .y = 0, .width = CELL_SIZE, .height = CELL_SIZE };
+                Vector2 position = { .x = pos_x + tiles[y][x].x, .y = pos_y + tiles[y][x].y };
+                if (tiles[y][x].x < 0) {
+                    int32 clamp = fabsf(tiles[y][x].x);
                     source.x = clamp;
                     source.width = CELL_SIZE - clamp;
                     position.x = pos_x;
@@ -325,15 +591,15 @@ void board_draw(uint16 pos_x, uint16 pos_y) {
                         .height = CELL_SIZE
                     };
                     Vector2 position2 = {
-                        .x = pos_x + board.tiles[y][BOARD_WIDTH - 1].x + CELL_SIZE,
-                        .y = pos_y + board.tiles[y][x].y,
+                        .x = pos_x + tiles[y][snapshot->width - 1].x + CELL_SIZE,
+                        .y = pos_y + tiles[y][x].y,
                     };
                     DrawTextureRec(*tile, source2, position2, WHITE);
                     printf("Source .x %f .width %f\n", source2.x, source2.width);
                     printf("Position .x %f .y %f\n", position2.x, position2.y);
                 }
-                else if (board.tiles[y][x].x > (BOARD_WIDTH - 1) * CELL_SIZE) {
-                    int32 clamp = board.tiles[y][x].x - (BOARD_WIDTH - 1) * CELL_SIZE;
+                else if (tiles[y][x].x > (snapshot->width - 1) * CELL_SIZE) {
+                    int32 clamp = tiles[y][x].x - (snapshot->width - 1) * CELL_SIZE;
                     source.x = 0;
                     source.width = CELL_SIZE - clamp;
                     Rectangle source2 = {
@@ -344,7 +610,7 @@ void board_draw(uint16 pos_x, uint16 pos_y) {
                     };
                     Vector2 position2 = {
                         .x = pos_x,
-                        .y = pos_y + board.tiles[y][x].y,
+                        .y = pos_y + tiles[y][x].y,
                     };
                     DrawTextureRec(*tile, source2, position2, WHITE);
                     printf("Source .x %f .width %f\n", source2.x, source2.width);
@@ -354,13 +620,13 @@ void board_draw(uint16 pos_x, uint16 pos_y) {
             }
         }
     }
-    DrawTextureEx(board.arrow_texture, (Vector2){pos_x, pos_y + CELL_SIZE * (board.cursor_row + 1)}, 180, 1, WHITE);
-    DrawTexture(board.arrow_texture, pos_x + CELL_SIZE * BOARD_WIDTH, pos_y + CELL_SIZE * board.cursor_row, WHITE);
+    DrawTextureEx(board.arrow_texture, (Vector2){pos_x, pos_y + CELL_SIZE * (snapshot->cursor_row + 1)}, 180, 1, WHITE);
+    DrawTexture(board.arrow_texture, pos_x + CELL_SIZE * snapshot->width, pos_y + CELL_SIZE * snapshot->cursor_row, WHITE);
 }
 
 bool board_tiles_empty() {
-    for (int y = 1; y < BOARD_HEIGHT; y++) {
-        for (int x = 0; x < BOARD_WIDTH; x++) {
+    for (int y = 1; y < board.height; y++) {
+        for (int x = 0; x < board.width; x++) {
             if (board.tiles[y][x].tile_type == TILETYPE_EMPTY) {
                 return true;
             }
@@ -370,7 +636,7 @@ bool board_tiles_empty() {
 }
 
 bool board_first_row_tiles_empty() {
-    for (int x = 0; x < BOARD_WIDTH; x++) {
+    for (int x = 0; x < board.width; x++) {
         if (board.tiles[0][x].tile_type == TILETYPE_EMPTY && board.tiles[1][x].tile_type == TILETYPE_EMPTY) {
             return true;
         }
@@ -379,8 +645,8 @@ bool board_first_row_tiles_empty() {
 }
 
 bool board_tiles_falling() {
-    for (int y = 0; y < BOARD_HEIGHT; y++) {
-        for (int x = 0; x < BOARD_WIDTH; x++) {
+    for (int y = 0; y < board.height; y++) {
+        for (int x = 0; x < board.width; x++) {
             if (board.tiles[y][x].falling == true) {
                 return true;
             }
@@ -389,72 +655,6 @@ bool board_tiles_falling() {
     return false;
 }
 
-void board_find_horiz_matches() {
-    int ranges_cnt = 0;
-    for (int y = 1; y < BOARD_HEIGHT; y++) {
-        TileType type = board.tiles[y][0].tile_type;
-        if (type == TILETYPE_EMPTY) {
-            continue;
-        }
-        board.horiz_ranges[ranges_cnt].start = (BoardPos){0, y};
-        int tiles_matching = 1;
-        for (int x = 1; x < BOARD_WIDTH; x++) {
-            if (board.tiles[y][x].tile_type == type) {
-                tiles_matching++;
-                board.horiz_ranges[ranges_cnt].end = (BoardPos){x, y};
-            } else {
-                if (tiles_matching >= 3) {
-                    ranges_cnt++;
-                    board.horiz_ranges[ranges_cnt].end = (BoardPos){x, y};
-                }
-                type = board.tiles[y][x].tile_type;
-                if (type == TILETYPE_EMPTY) {
-                    continue;
-                }
-                tiles_matching = 1;
-                board.horiz_ranges[ranges_cnt].start = (BoardPos){x, y};
-            }
-        }
-        if (tiles_matching >= 3) {
-            ranges_cnt++;
-        }
-    }
-    board.horiz_ranges_cnt = ranges_cnt;
-}
-
-void board_find_vert_matches() {
-    int ranges_cnt = 0;
-    for (int x = 0; x < BOARD_WIDTH; x++) {
-        TileType type = board.tiles[1][x].tile_type;
-        if (type == TILETYPE_EMPTY) {
-            continue;
-        }
-        board.vert_ranges[ranges_cnt].start = (BoardPos){x, 1};
-        int tiles_matching = 1;
-        for (int y = 2; y < BOARD_HEIGHT; y++) {
-            if (board.tiles[y][x].tile_type == type) {
-                tiles_matching++;
-                board.vert_ranges[ranges_cnt].end = (BoardPos){x, y};
-            } else {
-                if (tiles_matching >= 3) {
-                    ranges_cnt++;
-                    board.vert_ranges[ranges_cnt].end = (BoardPos){x, y};
-                }
-                type = board.tiles[y][x].tile_type;
-                if (type == TILETYPE_EMPTY) {
-                    continue;
-                }
-                tiles_matching = 1;
-                board.vert_ranges[ranges_cnt].start = (BoardPos){x, y};
-            }
-        }
-        if (tiles_matching >= 3) {
-            ranges_cnt++;
-        }
-    }
-    board.vert_ranges_cnt = ranges_cnt;
-}
-
 void board_anime_horiz_range(BoardRange range) {
     for (int x = range.start.x; x <= range.end.x; x++) {
         board.tiles[range.start.y][x].frame++;
@@ -491,31 +691,10 @@ void board_delete_vert_range(BoardRange range) {
     }
 }
 
-void board_rotate_row_left(int row) {
-    Tile temp = board.tiles[row][0];
-    int n = 1;
-    for (; n < BOARD_WIDTH; n++) {
-        board.tiles[row][n - 1].tile_type = board.tiles[row][n].tile_type;
-    }
-    board.tiles[row][n - 1].tile_type = temp.tile_type;
+uint32 board_get_width() {
+    return board.width;
 }
 
-void board_rotate_row_right(int row) {
-    Tile temp = board.tiles[row][BOARD_WIDTH - 1];
-    int n = BOARD_WIDTH - 2;
-    for (; n >= 0; n--) {
-        board.tiles[row][n + 1].tile_type = board.tiles[row][n].tile_type;
-    }
-    board.tiles[row][0].tile_type = temp.tile_type;
-}
-
-int board_find_row_dest(int x, int start) {
-    int dest = start;
-    for (; dest < BOARD_HEIGHT - 1; dest++) {
-        if (board.tiles[dest + 1][x].tile_type != TILETYPE_EMPTY) {
-            break;
-        }
-    }
-    return dest;
+uint32 board_get_height() {
+    return board.height;
 }
-
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "circuitbreaker.h"
+
+/*
+ * Starting board generator:
+ *
+ * Rows 1..height-1 are filled cell by cell. Each cell only picks among the
+ * types that don't complete a horizontal or vertical three with its already
+ * placed neighbours, so the board never contains a match.
+ *
+ * Filling top-down, a cell sees at most the pair above and the pair to its
+ * left, so one of the three types is always left. A repaired row also has
+ * the rows below it. The vertical pairs can then forbid two types and the
+ * pair to the left the third. The repair gives up and the row is restored.
+ *
+ * A move (rotate a row left or right) is productive if it creates a match.
+ * Rotating row r can only create matches on row r and on the columns
+ * through rows r-2..r+2, so move counts are kept per row. When the board has
+ * fewer than min_moves productive moves, one row is regenerated and only the
+ * rows it can influence are recounted.
+ *
+ * Moves are counted on bitmasks, one per row and tile type with bit x set
+ * where the tile at x has that type. A rotation is a shift and an or,
+ * horizontal threes are m & m >> 1 & m >> 2 and vertical threes an and
+ * across three rows, so no rotated row is ever built.
+ *
+ * Some sizes can't reach a high min_moves at all. After
+ * BOARDGEN_MAX_RESTARTS fresh boards board_generate gives up and returns
+ * false, the caller decides whether the board is usable.
+ *
+ * Difficulty is reported as the productive move count, fewer is harder.
+ * Matching rules mirror board_kernel_find_matches.
+*/
+
+#define BOARDGEN_MAX_REPAIRS 64
+#define BOARDGEN_MAX_RESTARTS 16
+
+uint64 boardgen_random64(BoardGenerator *gen) {
+    // xorshift64*, local state keeps the generator deterministic per seed
+    gen->rng ^= gen->rng >> 12;
+    gen->rng ^= gen->rng << 25;
+    gen->rng ^= gen->rng >> 27;
+    return gen->rng * 0x2545F4914F6CDD1DULL;
+}
+
+uint32 boardgen_random(BoardGenerator *gen) {
+    return (uint32)(boardgen_random64(gen) >> 32);
+}
+
+void board_generator_init(BoardGenerator *gen, uint64 seed, uint32 min_moves) {
+    *gen = (BoardGenerator){0};
+    gen->rng = seed ? seed : 0x9E3779B97F4A7C15ULL;
+    gen->min_moves = min_moves;
+}
+
+bool32 boardgen_same3(uint8 a, uint8 b, uint8 c) {
+    return a != TILETYPE_EMPTY && a == b && a == c;
+}
+
+// Indexed by the allowed types as a 3-bit mask, bit n is tile type n + 1
+global_variable const uint8 boardgen_pick_cnt[8] = {0, 1, 1, 2, 1, 2, 2, 3};
+global_variable const uint8 boardgen_pick_types[8][3] = {
+    {0, 0, 0},
+    {TILETYPE_ATTACK, 0, 0},
+    {TILETYPE_ACTION, 0, 0},
+    {TILETYPE_ATTACK, TILETYPE_ACTION, 0},
+    {TILETYPE_UTILITY, 0, 0},
+    {TILETYPE_ATTACK, TILETYPE_UTILITY, 0},
+    {TILETYPE_ACTION, TILETYPE_UTILITY, 0},
+    {TILETYPE_ATTACK, TILETYPE_ACTION, TILETYPE_UTILITY},
+};
+
+bool32 boardgen_fill_row(BoardGenerator *gen, uint32 width, uint32 height,
+                         uint8 cells[BOARD_MAX_HEIGHT][BOARD_MAX_WIDTH],
+                         uint8 masks[BOARD_MAX_HEIGHT][TILETYPE_CNT], uint32 y) {
+    // Per tile type, the columns where the rows above and below already hold
+    // a pair that this row would complete
+    uint32 vertical[TILETYPE_CNT] = {0};
+    for (uint32 t = TILETYPE_EMPTY + 1; t < TILETYPE_CNT; t++) {
+        if (y >= 3) {
+            vertical[t] |= masks[y - 1][t] & masks[y - 2][t];
+        }
+        if (y >= 2 && y + 1 < height) {
+            vertical[t] |= masks[y - 1][t] & masks[y + 1][t];
+        }
+        if (y + 2 < height) {
+            vertical[t] |= masks[y + 1][t] & masks[y + 2][t];
+        }
+    }
+
+    uint8 row_masks[TILETYPE_CNT] = {0};
+    uint64 random = 0;
+    for (uint32 x = 0; x < width; x++) {
+        // Bit n is tile type n + 1, the same layout as the pick tables
+        uint32 forbidden = 0;
+        for (uint32 t = TILETYPE_EMPTY + 1; t < TILETYPE_CNT; t++) {
+            forbidden |= ((vertical[t] >> x) & 1) << (t - 1);
+        }
+        if (x >= 2 && cells[y][x - 1] == cells[y][x - 2]) {
+            forbidden |= 1 << (cells[y][x - 1] - 1);
+        }
+        uint32 allowed = ~forbidden & 0x7;
+        if (allowed == 0) {
+            return false;
+        }
+
+        // 16 random bits per cell, multiply-shift maps them onto 0..cnt-1 without a divide
+        if (x % 4 == 0) {
+            random = boardgen_random64(gen);
+        }
+        uint32 pick = (uint32)(((random >> 48) * boardgen_pick_cnt[allowed]) >> 16);
+        random <<= 16;
+        uint8 tile_type = boardgen_pick_types[allowed][pick];
+        cells[y][x] = tile_type;
+        row_masks[tile_type] |= 1 << x;
+    }
+    memcpy(masks[y], row_masks, sizeof(row_masks));
+    return true;
+}
+
+bool32 boardgen_rotation_matches(uint32 width, uint32 height,
+                                 uint8 masks[BOARD_MAX_HEIGHT][TILETYPE_CNT], uint32 r, InputEvent direction) {
+    uint32 full = (1 << width) - 1;
+    for (uint32 t = TILETYPE_EMPTY + 1; t < TILETYPE_CNT; t++) {
+        uint32 m = masks[r][t];
+        // Rotating left moves the tile at x + 1 to x, bit 0 wraps to the top
+        uint32 row = direction == INPUT_LEFT ?
+            (m >> 1) | ((m & 1) << (width - 1)) :
+            ((m << 1) & full) | (m >> (width - 1));
+        uint32 match = row & (row >> 1) & (row >> 2);
+        if (r >= 3) {
+            match |= row & masks[r - 1][t] & masks[r - 2][t];
+        }
+        if (r >= 2 && r + 1 < height) {
+            match |= row & masks[r - 1][t] & masks[r + 1][t];
+        }
+        if (r + 2 < height) {
+            match |= row & masks[r + 1][t] & masks[r + 2][t];
+        }
+        if (match) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32 boardgen_row_moves(uint32 width, uint32 height,
+                          uint8 masks[BOARD_MAX_HEIGHT][TILETYPE_CNT], uint32 r) {
+    return boardgen_rotation_matches(width, height, masks, r, INPUT_LEFT) +
+        boardgen_rotation_matches(width, height, masks, r, INPUT_RIGHT);
+}
+
+bool32 board_generate(BoardGenerator *gen, uint32 width, uint32 height,
+                      uint8 cells[BOARD_MAX_HEIGHT][BOARD_MAX_WIDTH], uint32 *productive_moves) {
+    Assert(width >= BOARD_MIN_WIDTH && width <= BOARD_MAX_WIDTH && height >= BOARD_MIN_HEIGHT && height <= BOARD_MAX_HEIGHT);
+    uint32 min_moves = gen->min_moves;
+    uint32 row_moves[BOARD_MAX_HEIGHT] = {0};
+    uint8 masks[BOARD_MAX_HEIGHT][TILETYPE_CNT];
+    uint8 saved_row[BOARD_MAX_WIDTH];
+    uint8 best[BOARD_MAX_HEIGHT][BOARD_MAX_WIDTH];
+    uint32 best_moves = 0;
+    uint32 moves = 0;
+
+    for (uint32 restart = 0; restart < BOARDGEN_MAX_RESTARTS; restart++) {
+        memset(cells, 0, sizeof(uint8) * BOARD_MAX_HEIGHT * BOARD_MAX_WIDTH);
+        memset(masks, 0, sizeof(masks));
+        for (uint32 y = 1; y < height; y++) {
+            // Top-down there are no rows below yet, this can't run out of types
+            if (!boardgen_fill_row(gen, width, height, cells, masks, y)) {
+                Assert(false);
+            }
+        }
+        moves = 0;
+        for (uint32 y = 1; y < height; y++) {
+            row_moves[y] = boardgen_row_moves(width, height, masks, y);
+            moves += row_moves[y];
+        }
+
+        for (uint32 repair = 0; moves < min_moves && repair < BOARDGEN_MAX_REPAIRS; repair++) {
+            uint32 y = 1 + boardgen_random(gen) % (height - 1);
+            gen->repairs_cnt++;
+            memcpy(saved_row, cells[y], width);
+            if (!boardgen_fill_row(gen, width, height, cells, masks, y)) {
+                memcpy(cells[y], saved_row, width);
+                gen->failed_repairs_cnt++;
+                continue;
+            }
+            uint32 first = y > 2 ? y - 2 : 1;
+            uint32 last = y + 2 < height - 1 ? y + 2 : height - 1;
+            for (uint32 r = first; r <= last; r++) {
+                moves -= row_moves[r];
+                row_moves[r] = boardgen_row_moves(width, height, masks, r);
+                moves += row_moves[r];
+            }
+        }
+        if (moves >= min_moves) {
+            break;
+        }
+        if (restart == 0 || moves > best_moves) {
+            best_moves = moves;
+            memcpy(best, cells, sizeof(best));
+        }
+        gen->restarts_cnt++;
+    }
+
+    if (moves < min_moves) {
+        // Still hand back a valid match-free board, just not one with enough moves
+        memcpy(cells, best, sizeof(best));
+        *productive_moves = best_moves;
+        gen->shortfall_cnt++;
+        return false;
+    }
+
+    gen->boards_cnt++;
+    gen->moves_histogram[moves]++;
+    *productive_moves = moves;
+    return true;
+}
+
+void board_generator_report(const BoardGenerator *gen) {
+    printf("boardgen: %llu boards, %llu row repairs (%llu failed), %llu restarts, %llu rejected short of min moves\n",
+           (unsigned long long)gen->boards_cnt,
+           (unsigned long long)gen->repairs_cnt,
+           (unsigned long long)gen->failed_repairs_cnt,
+           (unsigned long long)gen->restarts_cnt,
+           (unsigned long long)gen->shortfall_cnt);
+    for (uint32 n = 0; n <= BOARDGEN_MAX_MOVES; n++) {
+        if (gen->moves_histogram[n] == 0) {
+            continue;
+        }
+        printf("boardgen: %2u productive moves: %llu (%.1f%%)\n", n,
+               (unsigned long long)gen->moves_histogram[n],
+               100.0 * gen->moves_histogram[n] / gen->boards_cnt);
+    }
+}
+
+bool32 board_generate_bench(uint32 boards, uint32 min_moves, uint32 seed) {
+    uint32 width = board_get_width();
+    uint32 height = board_get_height();
+    if (min_moves > 2 * (height - 1)) {
+        printf("boardgen: %ux%u has at most %u moves, can't ask for %u\n", width, height, 2 * (height - 1), min_moves);
+        return false;
+    }
+    BoardGenerator gen;
+    board_generator_init(&gen, seed, min_moves);
+
+    uint8 cells[BOARD_MAX_HEIGHT][BOARD_MAX_WIDTH];
+    uint64 checksum = 0;
+    uint64 start = pacer_now_ns();
+    for (uint32 n = 0; n < boards; n++) {
+        uint32 moves;
+        if (board_generate(&gen, width, height, cells, &moves)) {
+            checksum += moves + cells[height - 1][width - 1];
+        }
+#if defined(CIRCUITBREAKER_SLOW)
+        // Every board handed out has to be match-free, shortfall or not
+        for (uint32 y = 1; y < height; y++) {
+            for (uint32 x = 0; x < width; x++) {
+                Assert(cells[y][x] != TILETYPE_EMPTY);
+                Assert(x < 2 || !boardgen_same3(cells[y][x], cells[y][x - 1], cells[y][x - 2]));
+                Assert(y < 3 || !boardgen_same3(cells[y][x], cells[y - 1][x], cells[y - 2][x]));
+            }
+        }
+#endif
+    }
+    real64 elapsed = pacer_seconds(pacer_now_ns() - start);
+
+    printf("boardgen: %ux%u min moves %u, %llu of %u boards in %.3fs (%.0f/s, checksum %llu)\n",
+           width, height, min_moves, (unsigned long long)gen.boards_cnt, boards, elapsed,
+           gen.boards_cnt / elapsed, (unsigned long long)checksum);
+    board_generator_report(&gen);
+    return true;
+}
@@ -0,0 +1,320 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "circuitbreaker.h"
+
+/*
+ * Transition dataset file:
+ *
+ * [header, padded to DATASET_ALIGNMENT]
+ * [chunk 0] [chunk 1] ... [chunk n - 1]
+ * [chunk index]
+ *
+ * Every chunk holds room for DATASET_CHUNK_RECORDS records stored column by
+ * column, so a reader can mmap the file and hand out column pointers
+ * without copying or parsing. The last chunk is written at full size too,
+ * the index says how many records each chunk actually holds.
+ *
+ * Games are stored back to back. game says which game a record belongs to
+ * and done marks its last move, so readers never treat the jump from one
+ * game to the next as a transition.
+ *
+ * Column layout inside a chunk, N = DATASET_CHUNK_RECORDS:
+ *   uint64 board[N][2]     2 bits per tile, row major
+ *   real32 reward[N]
+ *   uint32 game[N]
+ *   uint16 tiles_broken[N]
+ *   uint8  cascade_tiles[N][BOARD_MAX_CASCADE_EVENTS]
+ *   uint8  cursor_row[N]
+ *   uint8  direction[N]    INPUT_LEFT or INPUT_RIGHT
+ *   uint8  cascades[N]
+ *   uint8  done[N]
+*/
+
+#define DATASET_RECORD_SIZE \
+    (2 * sizeof(uint64) + sizeof(real32) + sizeof(uint32) + sizeof(uint16) + BOARD_MAX_CASCADE_EVENTS + 4 * sizeof(uint8))
+#define DATASET_CHUNK_SIZE (DATASET_ALIGNMENT_UP(DATASET_CHUNK_RECORDS * DATASET_RECORD_SIZE))
+#define DATASET_ALIGNMENT_UP(Value) (((Value) + DATASET_ALIGNMENT - 1) & ~(uint64)(DATASET_ALIGNMENT - 1))
+
+DatasetColumns dataset_columns(uint8 *chunk) {
+    DatasetColumns columns;
+    uint64 offset = 0;
+    columns.board = (uint64 (*)[2])(chunk + offset);
+    offset += DATASET_CHUNK_RECORDS * 2 * sizeof(uint64);
+    columns.reward = (real32 *)(chunk + offset);
+    offset += DATASET_CHUNK_RECORDS * sizeof(real32);
+    columns.game = (uint32 *)(chunk + offset);
+    offset += DATASET_CHUNK_RECORDS * sizeof(uint32);
+    columns.tiles_broken = (uint16 *)(chunk + offset);
+    offset += DATASET_CHUNK_RECORDS * sizeof(uint16);
+    columns.cascade_tiles = (uint8 (*)[BOARD_MAX_CASCADE_EVENTS])(chunk + offset);
+    offset += DATASET_CHUNK_RECORDS * BOARD_MAX_CASCADE_EVENTS;
+    columns.cursor_row = chunk + offset;
+    offset += DATASET_CHUNK_RECORDS;
+    columns.direction = chunk + offset;
+    offset += DATASET_CHUNK_RECORDS;
+    columns.cascades = chunk + offset;
+    offset += DATASET_CHUNK_RECORDS;
+    columns.done = chunk + offset;
+    return columns;
+}
+
+bool32 dataset_write_all(int fd, const void *data, uint64 size) {
+    const uint8 *at = data;
+    while (size > 0) {
+        ssize_t written = write(fd, at, size);
+        if (written <= 0) {
+            return false;
+        }
+        at += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool32 dataset_writer_open(DatasetWriter *writer, const char *path, uint32 board_width, uint32 board_height) {
+    *writer = (DatasetWriter){0};
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer->fd < 0) {
+        printf("dataset: cannot open %s for writing\n", path);
+        return false;
+    }
+    writer->chunk = aligned_alloc(DATASET_ALIGNMENT, DATASET_CHUNK_SIZE);
+    if (!writer->chunk) {
+        close(writer->fd);
+        return false;
+    }
+    memset(writer->chunk, 0, DATASET_CHUNK_SIZE);
+    writer->columns = dataset_columns(writer->chunk);
+    writer->header.magic = DATASET_MAGIC;
+    writer->header.version = DATASET_VERSION;
+    writer->header.board_width = board_width;
+    writer->header.board_height = board_height;
+    writer->header.chunk_records = DATASET_CHUNK_RECORDS;
+    writer->header.chunk_size = DATASET_CHUNK_SIZE;
+
+    // Reserve the header, it is rewritten with the final counts on close
+    uint8 header[DATASET_ALIGNMENT] = {0};
+    if (!dataset_write_all(writer->fd, header, sizeof(header))) {
+        printf("dataset: cannot write to %s\n", path);
+        close(writer->fd);
+        free(writer->chunk);
+        *writer = (DatasetWriter){0};
+        return false;
+    }
+    return true;
+}
+
+bool32 dataset_writer_flush(DatasetWriter *writer) {
+    if (writer->chunk_fill == 0) {
+        return true;
+    }
+    if (writer->header.chunk_cnt == writer->index_capacity) {
+        uint64 capacity = writer->index_capacity ? writer->index_capacity * 2 : 64;
+        DatasetChunkIndex *index = realloc(writer->index, capacity * sizeof(DatasetChunkIndex));
+        if (!index) {
+            return false;
+        }
+        writer->index = index;
+        writer->index_capacity = capacity;
+    }
+    writer->index[writer->header.chunk_cnt] = (DatasetChunkIndex){
+        .offset = DATASET_ALIGNMENT + writer->header.chunk_cnt * DATASET_CHUNK_SIZE,
+        .first_record = writer->header.record_cnt - writer->chunk_fill,
+        .record_cnt = writer->chunk_fill,
+    };
+    writer->header.chunk_cnt++;
+    writer->chunk_fill = 0;
+    return dataset_write_all(writer->fd, writer->chunk, DATASET_CHUNK_SIZE);
+}
+
+bool32 dataset_writer_append(DatasetWriter *writer, uint32 game, bool32 done, const uint64 board[2],
+                             uint32 cursor_row, InputEvent direction, const BoardMoveResult *result) {
+    uint32 n = writer->chunk_fill;
+    writer->columns.board[n][0] = board[0];
+    writer->columns.board[n][1] = board[1];
+    writer->columns.reward[n] = result->reward;
+    writer->columns.game[n] = game;
+    writer->columns.tiles_broken[n] = result->tiles_broken < UINT16_MAX ? result->tiles_broken : UINT16_MAX;
+    memcpy(writer->columns.cascade_tiles[n], result->cascade_tiles, BOARD_MAX_CASCADE_EVENTS);
+    writer->columns.cursor_row[n] = (uint8)cursor_row;
+    writer->columns.direction[n] = (uint8)direction;
+    writer->columns.cascades[n] = result->cascades < UINT8_MAX ? result->cascades : UINT8_MAX;
+    writer->columns.done[n] = done ? 1 : 0;
+    writer->chunk_fill++;
+    writer->header.record_cnt++;
+    if (done) {
+        writer->header.game_cnt++;
+    }
+    if (writer->chunk_fill == DATASET_CHUNK_RECORDS) {
+        return dataset_writer_flush(writer);
+    }
+    return true;
+}
+
+bool32 dataset_writer_close(DatasetWriter *writer) {
+    bool32 ok = dataset_writer_flush(writer);
+    writer->header.index_offset = DATASET_ALIGNMENT + writer->header.chunk_cnt * DATASET_CHUNK_SIZE;
+    ok = ok && dataset_write_all(writer->fd, writer->index, writer->header.chunk_cnt * sizeof(DatasetChunkIndex));
+    ok = ok && pwrite(writer->fd, &writer->header, sizeof(writer->header), 0) == sizeof(writer->header);
+    ok = close(writer->fd) == 0 && ok;
+    free(writer->chunk);
+    free(writer->index);
+    return ok;
+}
+
+bool32 dataset_reader_validate(const DatasetReader *reader) {
+    const DatasetHeader *header = reader->header;
+    if (header->magic != DATASET_MAGIC ||
+        header->version != DATASET_VERSION ||
+        header->chunk_records != DATASET_CHUNK_RECORDS ||
+        header->chunk_size != DATASET_CHUNK_SIZE ||
+        header->index_offset > reader->size ||
+        header->index_offset % sizeof(uint64) != 0 ||
+        header->chunk_cnt > (reader->size - header->index_offset) / sizeof(DatasetChunkIndex)) {
+        return false;
+    }
+    const DatasetChunkIndex *index = (const DatasetChunkIndex *)((uint8 *)reader->base + header->index_offset);
+    // dataset_reader_get maps record n to chunk n / DATASET_CHUNK_RECORDS, every entry has to agree
+    uint64 record_cnt = 0;
+    for (uint64 chunk = 0; chunk < header->chunk_cnt; chunk++) {
+        const DatasetChunkIndex *entry = &index[chunk];
+        if (entry->offset < DATASET_ALIGNMENT ||
+            entry->offset % DATASET_ALIGNMENT != 0 ||
+            entry->offset > reader->size ||
+            reader->size - entry->offset < DATASET_CHUNK_SIZE ||
+            entry->record_cnt == 0 ||
+            entry->record_cnt > DATASET_CHUNK_RECORDS ||
+            entry->first_record != chunk * DATASET_CHUNK_RECORDS ||
+            (entry->record_cnt < DATASET_CHUNK_RECORDS && chunk + 1 != header->chunk_cnt)) {
+            return false;
+        }
+        record_cnt += entry->record_cnt;
+    }
+    return record_cnt == header->record_cnt;
+}
+
+bool32 dataset_reader_open(DatasetReader *reader, const char *path) {
+    *reader = (DatasetReader){0};
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("dataset: cannot open %s\n", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < DATASET_ALIGNMENT) {
+        close(fd);
+        return false;
+    }
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    reader->base = base;
+    reader->size = st.st_size;
+    reader->header = base;
+    if (!dataset_reader_validate(reader)) {
+        printf("dataset: %s is not a valid dataset file\n", path);
+        dataset_reader_close(reader);
+        return false;
+    }
+    reader->index = (const DatasetChunkIndex *)((uint8 *)base + reader->header->index_offset);
+    return true;
+}
+
+void dataset_reader_close(DatasetReader *reader) {
+    if (reader->base) {
+        munmap(reader->base, reader->size);
+    }
+    *reader = (DatasetReader){0};
+}
+
+DatasetColumns dataset_reader_chunk(const DatasetReader *reader, uint64 chunk) {
+    Assert(chunk < reader->header->chunk_cnt);
+    return dataset_columns((uint8 *)reader->base + reader->index[chunk].offset);
+}
+
+DatasetRecord dataset_reader_get(const DatasetReader *reader, uint64 record) {
+    Assert(record < reader->header->record_cnt);
+    uint64 chunk = record / DATASET_CHUNK_RECORDS;
+    uint32 n = record - reader->index[chunk].first_record;
+    DatasetColumns columns = dataset_reader_chunk(reader, chunk);
+    DatasetRecord result = {
+        .board = { columns.board[n][0], columns.board[n][1] },
+        .reward = columns.reward[n],
+        .game = columns.game[n],
+        .tiles_broken = columns.tiles_broken[n],
+        .cursor_row = columns.cursor_row[n],
+        .direction = columns.direction[n],
+        .cascades = columns.cascades[n],
+        .done = columns.done[n],
+    };
+    memcpy(result.cascade_tiles, columns.cascade_tiles[n], BOARD_MAX_CASCADE_EVENTS);
+    return result;
+}
+
+bool32 dataset_record_games(const char *path, uint32 games, uint32 moves, uint32 seed) {
+    uint32 width = board_get_width();
+    uint32 height = board_get_height();
+    DatasetWriter writer;
+    if (!dataset_writer_open(&writer, path, width, height)) {
+        return false;
+    }
+    writer.header.moves_per_game = moves;
+    writer.header.seed = seed;
+
+    uint64 start = pacer_now_ns();
+    bool32 ok = true;
+    for (uint32 game = 0; game < games && ok; game++) {
+        srand(seed + game);
+        // board_init hands out match-free boards without holes, nothing to settle
+        board_init();
+        BoardMoveResult result;
+        for (uint32 move = 0; move < moves && ok; move++) {
+            uint64 packed[2];
+            board_pack(packed);
+            uint32 row = 1 + rand() % (height - 1);
+            InputEvent direction = rand() % 2 ? INPUT_RIGHT : INPUT_LEFT;
+            board_apply_move(row, direction, &result);
+            ok = dataset_writer_append(&writer, game, move + 1 == moves, packed, row, direction, &result);
+        }
+    }
+    uint64 record_cnt = writer.header.record_cnt;
+    ok = dataset_writer_close(&writer) && ok;
+    real64 elapsed = pacer_seconds(pacer_now_ns() - start);
+    if (!ok) {
+        printf("dataset: write to %s failed\n", path);
+        return false;
+    }
+    printf("dataset: %llu transitions from %u games in %.2fs (%.0f/s)\n",
+           (unsigned long long)record_cnt, games, elapsed, record_cnt / elapsed);
+
+    DatasetReader reader;
+    if (!dataset_reader_open(&reader, path)) {
+        return false;
+    }
+    uint64 matching = 0;
+    uint64 done = 0;
+    for (uint64 chunk = 0; chunk < reader.header->chunk_cnt; chunk++) {
+        DatasetColumns columns = dataset_reader_chunk(&reader, chunk);
+        for (uint32 n = 0; n < reader.index[chunk].record_cnt; n++) {
+            matching += columns.cascades[n] > 0;
+            done += columns.done[n];
+        }
+    }
+    printf("dataset: %s %ux%u, %u games of %u moves (seed %u), %llu chunks, %llu moves with a match\n",
+           path, reader.header->board_width, reader.header->board_height,
+           reader.header->game_cnt, reader.header->moves_per_game, reader.header->seed,
+           (unsigned long long)reader.header->chunk_cnt, (unsigned long long)matching);
+    Assert(done == reader.header->game_cnt);
+    dataset_reader_close(&reader);
+    return true;
+}
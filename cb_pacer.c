@@ -0,0 +1,168 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <time.h>
+
+#include "circuitbreaker.h"
+
+/*
+ * Hybrid frame pacer:
+ *
+ * The frame deadline advances by a fixed period each frame. We sleep for
+ * the bulk of the remaining time and spin on the monotonic clock for the
+ * last spin_threshold nanoseconds, since the OS sleep granularity is too
+ * coarse to land on the deadline by itself. The spin threshold grows when we
+ * see the sleep overshoot, so a noisy scheduler costs CPU instead of frames.
+ *
+ * The sleep is cut into slices of at most poll_period with the poll callback
+ * run in between, so whoever polls input isn't held to the frame rate.
+ * The idle rate only slows down drawing. When the callback reports input
+ * during an idle wait, the rest of the frame runs at the active rate, so the
+ * response isn't drawn a whole idle period late.
+ *
+ * Timestamps are uint64 nanoseconds, real64 is only 24 bits of mantissa and
+ * can't hold time since boot.
+ *
+ * The game advances on the sim's fixed tick, so the pacer hands out no frame
+ * delta. Frame times in the report are measured between consecutive frame
+ * boundaries, so they include the draw and the buffer swap.
+*/
+
+#define PACER_SPIN_MIN 500000ULL
+#define PACER_SPIN_MAX 4000000ULL
+#define PACER_SPIN_STEP 100000ULL
+#define PACER_SPIN_DECAY 10000ULL
+#define PACER_REPORT_INTERVAL (5 * PACER_NS_PER_SECOND)
+
+uint64 pacer_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * PACER_NS_PER_SECOND + (uint64)ts.tv_nsec;
+}
+
+void pacer_sleep_ns(uint64 ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / PACER_NS_PER_SECOND);
+    ts.tv_nsec = (long)(ns % PACER_NS_PER_SECOND);
+    nanosleep(&ts, NULL);
+}
+
+real64 pacer_seconds(uint64 ns) {
+    return (real64)((double)ns / (double)PACER_NS_PER_SECOND);
+}
+
+uint64 pacer_period_ns(real64 fps) {
+    return (uint64)((double)PACER_NS_PER_SECOND / (double)fps);
+}
+
+void pacer_reset_stats(FramePacer *pacer) {
+    pacer->frame_cnt = 0;
+    pacer->idle_frame_cnt = 0;
+    pacer->jitter_sum = 0;
+    pacer->jitter_max = 0;
+    pacer->frame_time_min = UINT64_MAX;
+    pacer->frame_time_max = 0;
+}
+
+void pacer_init(FramePacer *pacer, real64 target_fps, real64 idle_fps, uint64 poll_period, PacerPollFunction *poll) {
+    Assert(!poll || poll_period > 0);
+    pacer->target_fps = target_fps;
+    pacer->idle_fps = idle_fps;
+    pacer->poll = poll;
+    pacer->poll_period = poll_period;
+    pacer->spin_threshold = PACER_SPIN_MIN * 2;
+    pacer->frame_start = pacer_now_ns();
+    pacer->deadline = pacer->frame_start;
+    pacer->last_report = pacer->frame_start;
+    pacer_reset_stats(pacer);
+}
+
+void pacer_report(FramePacer *pacer, uint64 now) {
+    uint64 elapsed = now - pacer->last_report;
+    if (elapsed < PACER_REPORT_INTERVAL || pacer->frame_cnt == 0) {
+        return;
+    }
+    printf("pacer: %.1f fps (%u idle) frame %.3f..%.3fms jitter avg %.3fms max %.3fms spin %.3fms\n",
+           pacer->frame_cnt / ((double)elapsed * 1e-9),
+           pacer->idle_frame_cnt,
+           pacer->frame_time_min * 1e-6,
+           pacer->frame_time_max * 1e-6,
+           (double)pacer->jitter_sum / pacer->frame_cnt * 1e-6,
+           pacer->jitter_max * 1e-6,
+           pacer->spin_threshold * 1e-6);
+    pacer->last_report = now;
+    pacer_reset_stats(pacer);
+}
+
+void pacer_wait(FramePacer *pacer, bool32 idle) {
+    real64 fps = idle && pacer->idle_fps > 0.0 ? pacer->idle_fps : pacer->target_fps;
+    uint64 now = pacer_now_ns();
+
+    if (fps > 0.0) {
+        uint64 period = pacer_period_ns(fps);
+        pacer->deadline += period;
+        // Don't try to catch up after a hitch or a rate change, just restart the cadence
+        if (pacer->deadline < now || pacer->deadline > now + period) {
+            pacer->deadline = now + period;
+        }
+
+        if (now + pacer->spin_threshold < pacer->deadline) {
+            uint64 overshoot = 0;
+            while (now + pacer->spin_threshold < pacer->deadline) {
+                uint64 sleep_time = pacer->deadline - now - pacer->spin_threshold;
+                if (pacer->poll && sleep_time > pacer->poll_period) {
+                    sleep_time = pacer->poll_period;
+                }
+                uint64 sleep_start = now;
+                pacer_sleep_ns(sleep_time);
+                now = pacer_now_ns();
+                uint64 slept = now - sleep_start;
+                if (slept > sleep_time && slept - sleep_time > overshoot) {
+                    overshoot = slept - sleep_time;
+                }
+                if (pacer->poll) {
+                    bool32 input = pacer->poll();
+                    now = pacer_now_ns();
+                    if (input && idle) {
+                        uint64 active_deadline = now + pacer_period_ns(pacer->target_fps);
+                        if (active_deadline < pacer->deadline) {
+                            pacer->deadline = active_deadline;
+                        }
+                        idle = false;
+                    }
+                }
+            }
+            if (overshoot > pacer->spin_threshold && pacer->spin_threshold < PACER_SPIN_MAX) {
+                pacer->spin_threshold += PACER_SPIN_STEP;
+            } else if (overshoot < pacer->spin_threshold / 2 && pacer->spin_threshold > PACER_SPIN_MIN) {
+                pacer->spin_threshold -= PACER_SPIN_DECAY;
+            }
+        }
+        while (now < pacer->deadline) {
+            now = pacer_now_ns();
+        }
+
+        uint64 jitter = now - pacer->deadline;
+        pacer->jitter_sum += jitter;
+        if (jitter > pacer->jitter_max) {
+            pacer->jitter_max = jitter;
+        }
+    } else {
+        pacer->deadline = now;
+    }
+
+    uint64 frame_time = now - pacer->frame_start;
+    pacer->frame_start = now;
+
+    pacer->frame_cnt++;
+    if (idle) {
+        pacer->idle_frame_cnt++;
+    }
+    if (frame_time < pacer->frame_time_min) {
+        pacer->frame_time_min = frame_time;
+    }
+    if (frame_time > pacer->frame_time_max) {
+        pacer->frame_time_max = frame_time;
+    }
+    pacer_report(pacer, now);
+}
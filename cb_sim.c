@@ -0,0 +1,175 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "circuitbreaker.h"
+
+/*
+ * Simulation thread:
+ *
+ * Board and street run here at a fixed tick rate, independent of how long
+ * the render thread takes to draw a frame.
+ *
+ * render -> input queue (SPSC ring) -> sim
+ * sim -> snapshot triple buffer -> render
+ *
+ * Triple buffer: the sim owns the back slot, the render thread owns the
+ * front slot and the middle slot is swapped atomically by either side.
+ * Publishing swaps back <-> middle and marks it fresh, acquiring swaps
+ * front <-> middle only when it is fresh. Neither side ever waits.
+ *
+ * The render thread polls input after each frame and between the pacer's
+ * sleep slices, which are at most one tick long. A key reaches the board
+ * within about two ticks while the render thread sleeps. A frame that is
+ * still drawing (a slow GPU frame) delays polling until it ends, so input
+ * latency is only bounded by the tick rate when frames are shorter than
+ * a tick.
+*/
+
+#define SIM_INPUT_QUEUE_SIZE 64
+#define SIM_SNAPSHOT_INDEX_MASK 0x3
+#define SIM_SNAPSHOT_FRESH 0x4
+#define SIM_MAX_TICK_LAG (PACER_NS_PER_SECOND / 4)
+
+typedef struct {
+    InputEvent events[SIM_INPUT_QUEUE_SIZE];
+    _Alignas(64) _Atomic uint32 head;
+    _Alignas(64) _Atomic uint32 tail;
+} InputQueue;
+
+typedef struct {
+    GameSnapshot slots[3];
+    _Alignas(64) _Atomic uint32 middle;
+    uint32 back;
+    uint32 front;
+} SnapshotBuffer;
+
+typedef struct {
+    pthread_t thread;
+    atomic_bool running;
+    real64 tick_rate;
+    uint64 tick;
+    bool32 game_over;
+    InputQueue input;
+    SnapshotBuffer snapshots;
+} Sim;
+
+Sim sim = {0};
+
+bool32 sim_push_input(InputEvent event) {
+    uint32 head = atomic_load_explicit(&sim.input.head, memory_order_relaxed);
+    uint32 tail = atomic_load_explicit(&sim.input.tail, memory_order_acquire);
+    if (head - tail >= SIM_INPUT_QUEUE_SIZE) {
+        return false;
+    }
+    sim.input.events[head % SIM_INPUT_QUEUE_SIZE] = event;
+    atomic_store_explicit(&sim.input.head, head + 1, memory_order_release);
+    return true;
+}
+
+bool32 sim_pop_input(InputEvent *event) {
+    uint32 tail = atomic_load_explicit(&sim.input.tail, memory_order_relaxed);
+    uint32 head = atomic_load_explicit(&sim.input.head, memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    *event = sim.input.events[tail % SIM_INPUT_QUEUE_SIZE];
+    atomic_store_explicit(&sim.input.tail, tail + 1, memory_order_release);
+    return true;
+}
+
+void sim_fill_snapshot(GameSnapshot *snapshot) {
+    snapshot->tick = sim.tick;
+    snapshot->game_over = sim.game_over;
+    board_snapshot(&snapshot->board);
+    street_snapshot(&snapshot->street);
+}
+
+void sim_publish() {
+    SnapshotBuffer *buffer = &sim.snapshots;
+    sim_fill_snapshot(&buffer->slots[buffer->back]);
+    uint32 prev = atomic_exchange_explicit(&buffer->middle, buffer->back | SIM_SNAPSHOT_FRESH, memory_order_acq_rel);
+    buffer->back = prev & SIM_SNAPSHOT_INDEX_MASK;
+}
+
+const GameSnapshot *sim_acquire_snapshot() {
+    SnapshotBuffer *buffer = &sim.snapshots;
+    if (atomic_load_explicit(&buffer->middle, memory_order_relaxed) & SIM_SNAPSHOT_FRESH) {
+        uint32 prev = atomic_exchange_explicit(&buffer->middle, buffer->front, memory_order_acq_rel);
+        buffer->front = prev & SIM_SNAPSHOT_INDEX_MASK;
+    }
+    return &buffer->slots[buffer->front];
+}
+
+void sim_handle_input(InputEvent event) {
+    if (event == INPUT_RESTART) {
+        if (sim.game_over) {
+            board_init();
+            street_init();
+            sim.game_over = false;
+        }
+    } else if (!sim.game_over) {
+        board_input(event);
+    }
+}
+
+void *sim_thread(void *arg) {
+    // dt is what the board sees, the schedule itself runs on integer nanoseconds
+    uint64 tick_ns = pacer_period_ns(sim.tick_rate);
+    real64 dt = pacer_seconds(tick_ns);
+    uint64 next_tick = pacer_now_ns();
+
+    while (atomic_load_explicit(&sim.running, memory_order_acquire)) {
+        InputEvent event;
+        while (sim_pop_input(&event)) {
+            sim_handle_input(event);
+        }
+
+        if (!sim.game_over) {
+            board_update(dt);
+            street_update(dt);
+        }
+        sim.tick++;
+        sim_publish();
+
+        next_tick += tick_ns;
+        uint64 now = pacer_now_ns();
+        if (next_tick > now) {
+            pacer_sleep_ns(next_tick - now);
+        } else if (now - next_tick > SIM_MAX_TICK_LAG) {
+            // Too far behind to catch up, drop the missed ticks
+            next_tick = now;
+        }
+    }
+    return NULL;
+}
+
+void sim_start(real64 tick_rate) {
+    Assert(tick_rate > 0.0);
+    sim.tick_rate = tick_rate;
+    sim.tick = 0;
+    sim.game_over = false;
+    atomic_store(&sim.input.head, 0);
+    atomic_store(&sim.input.tail, 0);
+
+    // The render thread may draw before the first tick, so every slot starts valid
+    for (int n = 0; n < 3; n++) {
+        sim_fill_snapshot(&sim.snapshots.slots[n]);
+    }
+    sim.snapshots.front = 0;
+    atomic_store(&sim.snapshots.middle, 1);
+    sim.snapshots.back = 2;
+
+    atomic_store(&sim.running, true);
+    if (pthread_create(&sim.thread, NULL, sim_thread, NULL) != 0) {
+        printf("sim: failed to start simulation thread\n");
+        atomic_store(&sim.running, false);
+        Assert(false);
+    }
+}
+
+void sim_stop() {
+    if (atomic_exchange(&sim.running, false)) {
+        pthread_join(sim.thread, NULL);
+    }
+}
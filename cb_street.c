@@ -18,13 +18,22 @@ typedef struct {
 
 Street street = {0};
 
-void street_init() {
+void street_load() {
     street.tex_background = LoadTexture("resources/cyberpunk_street_background.png");
     street.tex_midground = LoadTexture("resources/cyberpunk_street_midground.png");
     street.tex_foreground = LoadTexture("resources/cyberpunk_street_foreground.png");
     street.tex_hero = LoadTexture("resources/Cyborg_run.png");
 }
 
+void street_init() {
+    street.background_pos = (Vector2){0};
+    street.midground_pos = (Vector2){0};
+    street.foreground_pos = (Vector2){0};
+    street.hero_pos = (Vector2){0};
+    street.hero_frame = 0;
+    street.time = 0;
+}
+
 void street_update(real64 elapsed_time) {
     street.time += elapsed_time;
     street.background_pos.x += 5 * elapsed_time;
@@ -39,9 +48,16 @@ void street_update(real64 elapsed_time) {
     }
 }
 
-void hero_draw(uint16 pos_x, uint16 pos_y) {
+void street_snapshot(StreetSnapshot *snapshot) {
+    snapshot->background_x = street.background_pos.x;
+    snapshot->midground_x = street.midground_pos.x;
+    snapshot->foreground_x = street.foreground_pos.x;
+    snapshot->hero_frame = street.hero_frame;
+}
+
+void hero_draw(const StreetSnapshot *snapshot, uint16 pos_x, uint16 pos_y) {
     Rectangle source = {
-        .x = 48 * street.hero_frame,
+        .x = 48 * snapshot->hero_frame,
         .y = 0,
         .width = 48,
         .height = 48,
@@ -55,7 +71,7 @@ void hero_draw(uint16 pos_x, uint16 pos_y) {
     DrawTexturePro(street.tex_hero, source, dest, (Vector2){0}, 0.0, WHITE);
 }
 
-void street_draw(uint16 pos_x, uint16 pos_y) {
+void street_draw(const StreetSnapshot *snapshot, uint16 pos_x, uint16 pos_y) {
     // 512 x 192
     // 704 x 192
     Rectangle source = {
@@ -67,19 +83,19 @@ void street_draw(uint16 pos_x, uint16 pos_y) {
     Rectangle dest = {
         .x = pos_x,
         .y = pos_y,
-        .width = 128 * 2,
-        .height = 192 * 2,
+        .width = STREET_WIDTH,
+        .height = STREET_HEIGHT,
     };
     Vector2 origin = { 0 };
     DrawTexturePro(street.tex_background,
-                   (Rectangle){street.background_pos.x, street.background_pos.y, 128, 192},
+                   (Rectangle){snapshot->background_x, 0, 128, 192},
                    dest, origin, 0.0, WHITE); 
     DrawTexturePro(street.tex_midground, 
-                   (Rectangle){street.midground_pos.x, street.midground_pos.y, 128, 192},
+                   (Rectangle){snapshot->midground_x, 0, 128, 192},
                    dest, origin, 0.0, WHITE); 
     DrawTexturePro(street.tex_foreground,
-                   (Rectangle){street.foreground_pos.x, street.foreground_pos.y, 128, 192},
+                   (Rectangle){snapshot->foreground_x, 0, 128, 192},
                    dest, origin, 0.0, WHITE); 
 
-    hero_draw(pos_x, pos_y + 280);
+    hero_draw(snapshot, pos_x, pos_y + 280);
 }
@@ -6,8 +6,14 @@
 
 #define BOARD_WIDTH 4
 #define BOARD_HEIGHT 5
+#define BOARD_MIN_WIDTH 3
+#define BOARD_MIN_HEIGHT 4
+#define BOARD_MAX_WIDTH 8
+#define BOARD_MAX_HEIGHT 8
 #define CELL_SIZE 64
 #define HALF_CELL_SIZE 32
+#define STREET_WIDTH (128 * 2)
+#define STREET_HEIGHT (192 * 2)
 
 
 #if defined(CIRCUITBREAKER_SLOW)
@@ -24,6 +30,8 @@
 #define internal static
 #define local_persist static
 #define global_variable static
+#define force_inline static inline __attribute__((always_inline))
+#define unroll_loop _Pragma("GCC unroll 8")
 
 typedef int8_t int8;
 typedef int16_t int16;
@@ -39,13 +47,218 @@ typedef uint64_t uint64;
 typedef float real32;
 typedef float real64;
 
+typedef enum {
+	TILETYPE_EMPTY,
+	TILETYPE_ATTACK,
+	TILETYPE_ACTION,
+	TILETYPE_UTILITY,
+	TILETYPE_CNT,
+} TileType;
+
+typedef struct {
+	real64 x, y;
+	uint32 row_dest;
+	uint32 frame;
+	real64 vspeed;
+	TileType tile_type;
+	bool falling;
+	bool hrotating;
+} Tile;
+
+typedef enum {
+	INPUT_UP,
+	INPUT_DOWN,
+	INPUT_LEFT,
+	INPUT_RIGHT,
+	INPUT_RESTART,
+	INPUT_CNT,
+} InputEvent;
+
+typedef struct {
+	uint32 width, height;
+	Tile tiles[BOARD_MAX_HEIGHT][BOARD_MAX_WIDTH];
+	uint32 cursor_row;
+	bool32 idle;
+} BoardSnapshot;
+
+typedef struct {
+	real64 background_x;
+	real64 midground_x;
+	real64 foreground_x;
+	uint8 hero_frame;
+} StreetSnapshot;
+
+typedef struct {
+	uint64 tick;
+	bool32 game_over;
+	BoardSnapshot board;
+	StreetSnapshot street;
+} GameSnapshot;
+
+#define BOARD_MAX_CASCADE_EVENTS 8
+
+typedef struct {
+	uint32 cascades;
+	uint32 tiles_broken;
+	real32 reward;
+	// Tiles broken by each cascade round, later rounds add into the last slot
+	uint8 cascade_tiles[BOARD_MAX_CASCADE_EVENTS];
+} BoardMoveResult;
+
+void board_load();
+bool32 board_set_size(uint32 width, uint32 height);
 void board_init();
+void board_input(InputEvent event);
 void board_update(real64 elapsed_time);
-void board_draw(uint16 pos_x, uint16 pos_y);
+void board_snapshot(BoardSnapshot *snapshot);
+void board_draw(const BoardSnapshot *snapshot, uint16 pos_x, uint16 pos_y);
+bool32 board_is_idle();
+void board_settle(BoardMoveResult *result);
+void board_apply_move(uint32 row, InputEvent direction, BoardMoveResult *result);
+void board_pack(uint64 packed[2]);
+uint32 board_get_width();
+uint32 board_get_height();
 
+void street_load();
 void street_init();
 void street_update(real64 elapsed_time);
-void street_draw(uint16 pos_x, uint16 pos_y);
+void street_snapshot(StreetSnapshot *snapshot);
+void street_draw(const StreetSnapshot *snapshot, uint16 pos_x, uint16 pos_y);
+
+void sim_start(real64 tick_rate);
+void sim_stop();
+bool32 sim_push_input(InputEvent event);
+const GameSnapshot *sim_acquire_snapshot();
+
+#define PACER_NS_PER_SECOND 1000000000ULL
+
+typedef bool32 PacerPollFunction(void);
+
+typedef struct {
+	real64 target_fps;
+	real64 idle_fps;
+	// Called between sleep slices of at most poll_period, may be NULL.
+	// Returning true finishes an idle wait at the active rate.
+	PacerPollFunction *poll;
+	uint64 poll_period;
+	// Timestamps and durations in nanoseconds of CLOCK_MONOTONIC
+	uint64 spin_threshold;
+	uint64 frame_start;
+	uint64 deadline;
+	uint64 last_report;
+	uint32 frame_cnt;
+	uint32 idle_frame_cnt;
+	uint64 jitter_sum;
+	uint64 jitter_max;
+	uint64 frame_time_min;
+	uint64 frame_time_max;
+} FramePacer;
+
+void pacer_init(FramePacer *pacer, real64 target_fps, real64 idle_fps, uint64 poll_period, PacerPollFunction *poll);
+void pacer_wait(FramePacer *pacer, bool32 idle);
+uint64 pacer_now_ns();
+void pacer_sleep_ns(uint64 ns);
+real64 pacer_seconds(uint64 ns);
+uint64 pacer_period_ns(real64 fps);
+
+#define BOARDGEN_MAX_MOVES (2 * (BOARD_MAX_HEIGHT - 1))
+#define BOARD_START_MIN_MOVES 2
+
+typedef struct {
+	uint64 rng;
+	uint32 min_moves;
+	uint64 boards_cnt;
+	uint64 repairs_cnt;
+	uint64 failed_repairs_cnt;
+	uint64 restarts_cnt;
+	uint64 shortfall_cnt;
+	uint64 moves_histogram[BOARDGEN_MAX_MOVES + 1];
+} BoardGenerator;
+
+void board_generator_init(BoardGenerator *gen, uint64 seed, uint32 min_moves);
+bool32 board_generate(BoardGenerator *gen, uint32 width, uint32 height,
+                      uint8 cells[BOARD_MAX_HEIGHT][BOARD_MAX_WIDTH], uint32 *productive_moves);
+void board_generator_report(const BoardGenerator *gen);
+bool32 board_generate_bench(uint32 boards, uint32 min_moves, uint32 seed);
+
+#define DATASET_MAGIC 0x53444243 // "CBDS"
+#define DATASET_VERSION 2
+#define DATASET_ALIGNMENT Kilobytes(4)
+#define DATASET_CHUNK_RECORDS 65536
+
+typedef struct {
+	uint32 magic;
+	uint32 version;
+	uint32 board_width;
+	uint32 board_height;
+	uint32 chunk_records;
+	uint32 chunk_size;
+	uint32 game_cnt;
+	uint32 moves_per_game;
+	uint32 seed;
+	uint32 reserved;
+	uint64 record_cnt;
+	uint64 chunk_cnt;
+	uint64 index_offset;
+} DatasetHeader;
+
+typedef struct {
+	uint64 offset;
+	uint64 first_record;
+	uint32 record_cnt;
+	uint32 reserved;
+} DatasetChunkIndex;
+
+typedef struct {
+	uint64 (*board)[2];
+	real32 *reward;
+	uint32 *game;
+	uint16 *tiles_broken;
+	uint8 (*cascade_tiles)[BOARD_MAX_CASCADE_EVENTS];
+	uint8 *cursor_row;
+	uint8 *direction;
+	uint8 *cascades;
+	uint8 *done;
+} DatasetColumns;
+
+typedef struct {
+	uint64 board[2];
+	real32 reward;
+	uint32 game;
+	uint16 tiles_broken;
+	uint8 cascade_tiles[BOARD_MAX_CASCADE_EVENTS];
+	uint8 cursor_row;
+	uint8 direction;
+	uint8 cascades;
+	uint8 done;
+} DatasetRecord;
+
+typedef struct {
+	int fd;
+	DatasetHeader header;
+	uint8 *chunk;
+	DatasetColumns columns;
+	uint32 chunk_fill;
+	DatasetChunkIndex *index;
+	uint64 index_capacity;
+} DatasetWriter;
+
+typedef struct {
+	void *base;
+	uint64 size;
+	const DatasetHeader *header;
+	const DatasetChunkIndex *index;
+} DatasetReader;
+
+bool32 dataset_writer_open(DatasetWriter *writer, const char *path, uint32 board_width, uint32 board_height);
+bool32 dataset_writer_append(DatasetWriter *writer, uint32 game, bool32 done, const uint64 board[2],
+                             uint32 cursor_row, InputEvent direction, const BoardMoveResult *result);
+bool32 dataset_writer_close(DatasetWriter *writer);
+bool32 dataset_reader_open(DatasetReader *reader, const char *path);
+void dataset_reader_close(DatasetReader *reader);
+DatasetColumns dataset_reader_chunk(const DatasetReader *reader, uint64 chunk);
+DatasetRecord dataset_reader_get(const DatasetReader *reader, uint64 record);
+bool32 dataset_record_games(const char *path, uint32 games, uint32 moves, uint32 seed);
 
 struct GameMemory {
 	bool32 is_initialized;
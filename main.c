@@ -1,6 +1,8 @@
 #include "raylib.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
 
 #include "circuitbreaker.h"
@@ -8,19 +10,30 @@
 typedef struct {
     const uint16 screen_width;
     const uint16 screen_height;
-    real64 last_time;
-    real64 elapsed_time;
-    real64 current_time;
-    real64 wait_time;
-    real64 delta_time;
+    real64 target_fps;
+    real64 idle_fps;
+    real64 tick_rate;
+    const char *dataset_path;
+    uint32 dataset_games;
+    uint32 dataset_moves;
+    uint32 dataset_seed;
+    uint32 gen_boards;
+    uint32 gen_min_moves;
+    FramePacer pacer;
     Font font;
-    bool game_over;
 } Game;
 
 global_variable Game game = {
     .screen_width = 1280,
     .screen_height = 720,
-    .game_over = false,
+    .target_fps = 60,
+    // Draw rate while the board waits for a key, input is still polled every tick
+    .idle_fps = 20,
+    .tick_rate = 60,
+    .dataset_games = 1000,
+    .dataset_moves = 100,
+    .dataset_seed = 1,
+    .gen_min_moves = BOARD_START_MIN_MOVES,
 };
 
 void game_init(void) {
@@ -28,70 +41,147 @@ void game_init(void) {
     srand((unsigned) time(&t));
     game.font = LoadFont("resources/fonts/mecha.png");
 
+    board_load();
+    street_load();
     board_init();
     street_init();
 }
 
-void game_update(void) {
-    if (!game.game_over && true) {
-        board_update(game.delta_time);
-        street_update(game.delta_time);
-    } else {
-        if (IsKeyPressed(KEY_ENTER)) {
-            game_init();
-            game.game_over = false;
-        }
+bool32 game_update(void) {
+    // Runs after every input poll, EndDrawing's and the pacer's, so each press
+    // is seen once. The sim consumes it on its next tick.
+    bool32 input = false;
+    if (IsKeyPressed(KEY_UP)) {
+        input |= sim_push_input(INPUT_UP);
+    }
+    if (IsKeyPressed(KEY_DOWN)) {
+        input |= sim_push_input(INPUT_DOWN);
+    }
+    if (IsKeyPressed(KEY_LEFT)) {
+        input |= sim_push_input(INPUT_LEFT);
+    }
+    if (IsKeyPressed(KEY_RIGHT)) {
+        input |= sim_push_input(INPUT_RIGHT);
     }
+    if (IsKeyPressed(KEY_ENTER)) {
+        input |= sim_push_input(INPUT_RESTART);
+    }
+    return input;
 }
 
-void game_draw(void) {
+void game_draw(const GameSnapshot *snapshot) {
     BeginDrawing();
     ClearBackground(BLACK);
 
-    uint16 pos_x = game.screen_width / 2 - (HALF_CELL_SIZE * BOARD_WIDTH);
-    uint16 pos_y = ((game.screen_height / 8) * 6) - (HALF_CELL_SIZE * (BOARD_HEIGHT + 1));
+    uint16 pos_x = game.screen_width / 2 - (HALF_CELL_SIZE * snapshot->board.width);
+    uint16 pos_y = ((game.screen_height / 8) * 6) - (HALF_CELL_SIZE * (snapshot->board.height + 1));
+    uint16 street_x = pos_x;
+    uint16 street_y = 16;
+
+    // Rows 1..height-1 must clear the street and the screen bottom, tall boards
+    // get the street to their left and the full screen height instead
+    if (pos_y + CELL_SIZE < street_y + STREET_HEIGHT ||
+        pos_y + CELL_SIZE * snapshot->board.height > game.screen_height) {
+        pos_y = (game.screen_height - CELL_SIZE * snapshot->board.height) / 2;
+        street_x = pos_x - CELL_SIZE - STREET_WIDTH;
+        street_y = (game.screen_height - STREET_HEIGHT) / 2;
+    }
 
-    board_draw(pos_x, pos_y);
+    board_draw(&snapshot->board, pos_x, pos_y);
 
-    pos_y = 16;
-    street_draw(pos_x, pos_y);
+    street_draw(&snapshot->street, street_x, street_y);
 
     EndDrawing();
 }
 
-void game_update_and_draw(void) {
+const GameSnapshot *game_update_and_draw(void) {
+    const GameSnapshot *snapshot = sim_acquire_snapshot();
+    game_draw(snapshot);
     game_update();
-    game_draw();
+    return snapshot;
 }
 
-int main(int argc, char *argv[]) {
-    InitWindow(game.screen_width, game.screen_height, "Circuit Breaker");
+bool32 game_poll_input(void) {
+    PollInputEvents();
+    return game_update();
+}
 
-    game_init();
+void game_parse_args(int argc, char *argv[]) {
+    for (int n = 1; n < argc; n++) {
+        if (strcmp(argv[n], "--fps") == 0 && n + 1 < argc) {
+            real64 fps = atof(argv[++n]);
+            if (fps > 0.0) {
+                game.target_fps = fps;
+            } else {
+                printf("Invalid fps %s, keeping %.0f\n", argv[n], game.target_fps);
+            }
+        } else if (strcmp(argv[n], "--idle-fps") == 0 && n + 1 < argc) {
+            real64 idle_fps = atof(argv[++n]);
+            if (idle_fps > 0.0) {
+                game.idle_fps = idle_fps;
+            } else {
+                printf("Invalid idle fps %s, keeping %.0f\n", argv[n], game.idle_fps);
+            }
+        } else if (strcmp(argv[n], "--tick-rate") == 0 && n + 1 < argc) {
+            real64 tick_rate = atof(argv[++n]);
+            if (tick_rate > 0.0) {
+                game.tick_rate = tick_rate;
+            } else {
+                printf("Invalid tick rate %s, keeping %.0f\n", argv[n], game.tick_rate);
+            }
+        } else if (strcmp(argv[n], "--board") == 0 && n + 1 < argc) {
+            uint32 width = 0, height = 0;
+            n++;
+            if (sscanf(argv[n], "%ux%u", &width, &height) != 2 || !board_set_size(width, height)) {
+                printf("Invalid board size %s, keeping %ux%u\n", argv[n], BOARD_WIDTH, BOARD_HEIGHT);
+            }
+        } else if (strcmp(argv[n], "--dataset") == 0 && n + 1 < argc) {
+            game.dataset_path = argv[++n];
+        } else if (strcmp(argv[n], "--games") == 0 && n + 1 < argc) {
+            game.dataset_games = strtoul(argv[++n], NULL, 10);
+        } else if (strcmp(argv[n], "--moves") == 0 && n + 1 < argc) {
+            game.dataset_moves = strtoul(argv[++n], NULL, 10);
+        } else if (strcmp(argv[n], "--seed") == 0 && n + 1 < argc) {
+            game.dataset_seed = strtoul(argv[++n], NULL, 10);
+        } else if (strcmp(argv[n], "--gen-boards") == 0 && n + 1 < argc) {
+            game.gen_boards = strtoul(argv[++n], NULL, 10);
+        } else if (strcmp(argv[n], "--min-moves") == 0 && n + 1 < argc) {
+            game.gen_min_moves = strtoul(argv[++n], NULL, 10);
+        }
+    }
 
-    real64 target_fps = 60;
+    // Checked after the loop so the order of --fps and --idle-fps doesn't matter
+    if (game.idle_fps > game.target_fps) {
+        printf("Idle fps %.0f above fps %.0f, using %.0f\n", game.idle_fps, game.target_fps, game.target_fps);
+        game.idle_fps = game.target_fps;
+    }
+}
 
-    game.last_time = GetTime();
-    while (!WindowShouldClose()) {
-        game_update_and_draw();
+int main(int argc, char *argv[]) {
+    game_parse_args(argc, argv);
+
+    if (game.gen_boards > 0) {
+        return board_generate_bench(game.gen_boards, game.gen_min_moves, game.dataset_seed) ? 0 : 1;
+    }
+    if (game.dataset_path) {
+        // Headless: no window, no textures, just the move model
+        return dataset_record_games(game.dataset_path, game.dataset_games, game.dataset_moves, game.dataset_seed) ? 0 : 1;
+    }
 
-        game.current_time = GetTime();
-        game.elapsed_time = game.current_time - game.last_time;
+    InitWindow(game.screen_width, game.screen_height, "Circuit Breaker");
 
-        if (target_fps > 0.0) {
-            game.wait_time = (1.0f/(real64)target_fps) - game.elapsed_time;
-            if (game.wait_time > 0.0) {
-                WaitTime(game.wait_time);
-                game.current_time = GetTime();
-                game.delta_time = (real64)(game.current_time - game.last_time);
-            }
-        } else {
-            game.delta_time = game.elapsed_time;
-        }
+    game_init();
 
-        game.last_time = game.current_time;
+    sim_start(game.tick_rate);
+    // Input is polled at least once per tick while the pacer waits for the next frame
+    pacer_init(&game.pacer, game.target_fps, game.idle_fps, pacer_period_ns(game.tick_rate), game_poll_input);
+    while (!WindowShouldClose()) {
+        const GameSnapshot *snapshot = game_update_and_draw();
 
+        // Board idle means only the street is scrolling, so we can drop to the idle rate
+        pacer_wait(&game.pacer, !snapshot->game_over && snapshot->board.idle);
     }
+    sim_stop();
 
     CloseWindow();
 }